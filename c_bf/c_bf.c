@@ -3,30 +3,103 @@
 #include <stdlib.h>
 #include <string.h>
 
+#ifdef _MSC_VER
+#include <intrin.h>
+typedef long volatile BfRefCount;
+#define BfRefCount_Init(count, value) (*(count) = (value))
+#define BfRefCount_Increment(count) _InterlockedIncrement(count)
+#define BfRefCount_Decrement(count) _InterlockedDecrement(count)
+#else
+#include <stdatomic.h>
+typedef atomic_long BfRefCount;
+#define BfRefCount_Init(count, value) atomic_init(count, value)
+#define BfRefCount_Increment(count) (atomic_fetch_add(count, 1) + 1)
+#define BfRefCount_Decrement(count) (atomic_fetch_sub(count, 1) - 1)
+#endif // _MSC_VER
+
 void print_hello_world()
 {
     puts("Hello World!");
 }
 
-static int const DEFAULT_BUFFER_SIZE = 30000;
+struct BfProgram
+{
+  BfRefCount ref_count;
+  char* source;
+};
+
+struct BfProgram* BfProgram_Create(char const* source)
+{
+  if (source == NULL)
+    return NULL;
+  size_t const length = strlen(source);
+  struct BfProgram* program = malloc(sizeof(struct BfProgram) + length + 1);
+  if (program == NULL)
+    return NULL;
+  // The source is stored in the same allocation, directly after the struct.
+  BfRefCount_Init(&program->ref_count, 1);
+  program->source = (char*)(program + 1);
+  memcpy(program->source, source, length + 1);
+  return program;
+}
+
+struct BfProgram* BfProgram_Retain(struct BfProgram* program)
+{
+  if (program == NULL)
+    return NULL;
+  (void)BfRefCount_Increment(&program->ref_count);
+  return program;
+}
+
+BfBool BfProgram_Release(struct BfProgram* program)
+{
+  if (program == NULL)
+    return BfBool_False;
+  if (BfRefCount_Decrement(&program->ref_count) == 0)
+    free(program);
+  return BfBool_True;
+}
+
+char const* BfProgram_GetSource(struct BfProgram const* program)
+{
+  if (program == NULL)
+    return NULL;
+  return program->source;
+}
 
 BfBool BfMachine_Init(struct BfMachine* machine, struct BfIoDriver const* ioDriver)
 {
   if (machine == NULL || ioDriver == NULL)
     return BfBool_False;
-  machine->buffer_size = DEFAULT_BUFFER_SIZE;
-  int* buffer = malloc(machine->buffer_size * sizeof(int));
+  int* buffer = calloc(BfMachineTapeSize_Initial, sizeof(int));
   if (buffer == NULL)
     return BfBool_False;
-  memset(buffer, 0, machine->buffer_size);
+  machine->buffer_size = BfMachineTapeSize_Initial;
   machine->buffer = buffer;
   machine->data_pointer = 0;
   machine->instruction_pointer = 0;
   machine->program = NULL;
+  machine->shared_program = NULL;
   machine->io_driver = ioDriver;
   return BfBool_True;
 }
 
+static BfBool GrowBuffer(struct BfMachine* machine)
+{
+  if (machine->buffer_size >= BfMachineTapeSize_Max)
+    return BfBool_False;
+  int new_size = machine->buffer_size * 2;
+  if (new_size > BfMachineTapeSize_Max)
+    new_size = BfMachineTapeSize_Max;
+  int* new_buffer = realloc(machine->buffer, new_size * sizeof(int));
+  if (new_buffer == NULL)
+    return BfBool_False;
+  memset(new_buffer + machine->buffer_size, 0, (new_size - machine->buffer_size) * sizeof(int));
+  machine->buffer = new_buffer;
+  machine->buffer_size = new_size;
+  return BfBool_True;
+}
+
 static int* CopyIntBuffer(int const* src, size_t count)
 {
 
@@ -46,8 +119,13 @@ BfBool BfMachine_Copy(struct BfMachine* dest, struct BfMachine* src)
 
   dest->buffer = CopyIntBuffer(src->buffer, dest->buffer_size);
   if (dest->buffer == NULL)
+  {
+    dest->program = NULL;
+    dest->shared_program = NULL;
     return BfBool_False;
+  }
 
+  BfProgram_Retain(dest->shared_program);
   return BfBool_True;
 }
 
@@ -62,6 +140,8 @@ BfBool BfMachine_Clean(struct BfMachine* machine)
   machine->data_pointer = -1;
   machine->instruction_pointer = -1;
   machine->program = NULL;
+  BfProgram_Release(machine->shared_program);
+  machine->shared_program = NULL;
   machine->io_driver = NULL;
   return BfBool_True;
 }
@@ -72,15 +152,32 @@ BfBool BfMachine_LoadProgram(struct BfMachine* machine, char const* program)
     return BfBool_False;
   if (program == NULL)
     return BfBool_False;
+  BfProgram_Release(machine->shared_program);
+  machine->shared_program = NULL;
   machine->program = program;
   return BfBool_True;
 }
 
+BfBool BfMachine_LoadSharedProgram(struct BfMachine* machine, struct BfProgram* program)
+{
+  if (machine == NULL)
+    return BfBool_False;
+  if (program == NULL)
+    return BfBool_False;
+  BfProgram_Retain(program);
+  BfProgram_Release(machine->shared_program);
+  machine->shared_program = program;
+  machine->program = program->source;
+  return BfBool_True;
+}
+
 BfBool BfMachine_ClearProgram(struct BfMachine* machine)
 {
   if (machine == NULL)
     return BfBool_False;
   machine->program = NULL;
+  BfProgram_Release(machine->shared_program);
+  machine->shared_program = NULL;
   return BfBool_True;
 }
 
@@ -111,7 +208,7 @@ BfBool BfMachine_ExecuteProgram(struct BfMachine* machine)
       break;
 
     case '>':
-      if (machine->data_pointer == machine->buffer_size - 1)
+      if (machine->data_pointer == machine->buffer_size - 1 && GrowBuffer(machine) == BfBool_False)
         return BfBool_False;
       ++machine->data_pointer;
       break;
@@ -25,6 +25,28 @@ extern "C"
     void* context;
   };
 
+  typedef enum BfMachineTapeSize_
+  {
+    BfMachineTapeSize_Initial = 256,
+    BfMachineTapeSize_Max = 30000
+  } BfMachineTapeSize;
+
+  // Immutable, reference counted program. A single instance can be loaded into any number of
+  // machines, on any number of threads; only the reference count is ever modified after creation.
+  struct BfProgram;
+
+  struct BfProgram* BfProgram_Create(char const* source);
+
+  struct BfProgram* BfProgram_Retain(struct BfProgram* program);
+
+  BfBool BfProgram_Release(struct BfProgram* program);
+
+  // The returned pointer is only valid while the caller holds its own reference to program.
+  char const* BfProgram_GetSource(struct BfProgram const* program);
+
+  // Per-session state: registers, tape, I/O driver and the loaded program. A shared program is
+  // referenced through shared_program and never copied. The tape starts at
+  // BfMachineTapeSize_Initial cells and grows on demand up to BfMachineTapeSize_Max cells.
   struct BfMachine
   {
     int buffer_size;
@@ -32,6 +54,7 @@ extern "C"
     int data_pointer;
     int instruction_pointer;
     char const* program;
+    struct BfProgram* shared_program;
     struct BfIoDriver const* io_driver;
   };
 
@@ -43,8 +66,12 @@ extern "C"
 
   BfBool BfMachine_ClearProgram(struct BfMachine* machine);
 
+  // Borrows program, which must outlive its use by the machine. Any shared program held by the
+  // machine is released first.
   BfBool BfMachine_LoadProgram(struct BfMachine* machine, char const* program);
 
+  BfBool BfMachine_LoadSharedProgram(struct BfMachine* machine, struct BfProgram* program);
+
   BfBool BfMachine_ExecuteProgram(struct BfMachine* machine);
 
 #ifdef __cplusplus
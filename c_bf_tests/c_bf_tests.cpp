@@ -1,6 +1,8 @@
 #include "c_bf.h"
 #include "gtest/gtest.h"
 #include "gmock/gmock.h"
+#include <thread>
+#include <vector>
 
 #define DISABLE_SEMANTICS(className, semantics) \
   className(className semantics) = delete;\
@@ -16,9 +18,6 @@ public:
   BfMachineWrapper()
     : BfMachineWrapper(BfIoDriver{})
   {
-    // Need to call init outside of assert to ensure that it is executed in Release builds
-    auto result = BfMachine_Init(&m_machine, &m_ioDriver);
-    assert(result == BfBool_True);
   }
 
   BfMachineWrapper(BfIoDriver const& ioDriver)
@@ -73,6 +72,7 @@ std::ostream& operator<<(std::ostream& os, BfMachine const& value)
     << "data_pointer = " << value.data_pointer << std::endl
     << "instruction_pointer = " << value.instruction_pointer << std::endl
     << "program = " << std::hex << static_cast<void const*>(value.program) << std::dec << std::endl
+    << "shared_program = " << std::hex << static_cast<void const*>(value.shared_program) << std::dec << std::endl
     << "io_driver = " << value.io_driver << std::endl
     << "}";
 }
@@ -83,7 +83,8 @@ bool operator==(BfMachine const& lhs, BfMachine const& rhs)
     return lhs.buffer_size == rhs.buffer_size
       && lhs.data_pointer == rhs.data_pointer
       && lhs.instruction_pointer == rhs.instruction_pointer
-      && lhs.program == rhs.program;
+      && lhs.program == rhs.program
+      && lhs.shared_program == rhs.shared_program;
 
   if (std::memcmp(lhs.buffer, rhs.buffer, lhs.buffer_size * sizeof(int)) != 0)
     return false;
@@ -91,7 +92,8 @@ bool operator==(BfMachine const& lhs, BfMachine const& rhs)
   return lhs.buffer_size == rhs.buffer_size
     && lhs.data_pointer == rhs.data_pointer
     && lhs.instruction_pointer == rhs.instruction_pointer
-    && lhs.program == rhs.program;
+    && lhs.program == rhs.program
+    && lhs.shared_program == rhs.shared_program;
 }
 
 using Wrapper = BfMachineWrapper;
@@ -119,16 +121,17 @@ TEST(BfMachineTests, GivenABfMachineCheckThatItIsInitializedAndCleanedCorrectly)
   struct BfMachine machine;
 
   ASSERT_EQ(BfMachine_Init(&machine, &ioDriver), BfBool_True);
-  auto constexpr expectedBufferSize = 30000;
+  auto constexpr expectedBufferSize = BfMachineTapeSize_Initial;
   EXPECT_EQ(machine.buffer_size, expectedBufferSize);
   EXPECT_NE(machine.buffer, (int *)NULL);
   // TODO: check that malloc allocated the correct amount of memory (expectedBufferSize * sizeof(int))
   //ASSERT_EQ(sizeof machine.buffer, expectedBufferSize * sizeof(int));
   auto const expectedBuffer = std::vector<int>(expectedBufferSize);
-  EXPECT_TRUE(memcmp(machine.buffer, expectedBuffer.data(), expectedBufferSize) == 0);
+  EXPECT_TRUE(memcmp(machine.buffer, expectedBuffer.data(), expectedBufferSize * sizeof(int)) == 0);
   EXPECT_EQ(machine.data_pointer, 0);
   EXPECT_EQ(machine.instruction_pointer, 0);
   EXPECT_EQ(machine.program, nullptr);
+  EXPECT_EQ(machine.shared_program, nullptr);
   EXPECT_EQ(machine.io_driver, &ioDriver);
 
   auto const NonTrivialProgram = std::string("+");
@@ -141,6 +144,7 @@ TEST(BfMachineTests, GivenABfMachineCheckThatItIsInitializedAndCleanedCorrectly)
   ASSERT_EQ(machine.data_pointer, -1);
   ASSERT_EQ(machine.instruction_pointer, -1);
   ASSERT_EQ(machine.program, nullptr);
+  ASSERT_EQ(machine.shared_program, nullptr);
   ASSERT_EQ(machine.io_driver, nullptr);
 }
 
@@ -399,12 +403,41 @@ TEST(BfMachineTests, CheckExecutingRightMoreTimesThanTheBufferSizeReturnsFalse)
 {
   auto wrapper = BfMachineWrapper{};
   auto& machine = wrapper.get();
-  auto const tooManyRights = std::string(machine.buffer_size + 1, '>');
+  auto const tooManyRights = std::string(BfMachineTapeSize_Max + 1, '>');
   ASSERT_EQ(BfMachine_LoadProgram(&machine, tooManyRights.c_str()), BfBool_True);
 
   ASSERT_EQ(BfMachine_ExecuteProgram(&machine), BfBool_False);
 }
 
+TEST(BfMachineTests, CheckExecutingRightPastTheEndOfTheTapeGrowsTheTapeWithZeroedCells)
+{
+  auto wrapper = BfMachineWrapper{};
+  auto& machine = wrapper.get();
+  auto const rights = std::string(BfMachineTapeSize_Initial, '>');
+  ASSERT_EQ(BfMachine_LoadProgram(&machine, rights.c_str()), BfBool_True);
+
+  ASSERT_EQ(BfMachine_ExecuteProgram(&machine), BfBool_True);
+
+  ASSERT_EQ(machine.data_pointer, BfMachineTapeSize_Initial);
+  ASSERT_GT(machine.buffer_size, BfMachineTapeSize_Initial);
+  ASSERT_LE(machine.buffer_size, BfMachineTapeSize_Max);
+  auto const expectedBuffer = std::vector<int>(machine.buffer_size);
+  ASSERT_TRUE(memcmp(machine.buffer, expectedBuffer.data(), machine.buffer_size * sizeof(int)) == 0);
+}
+
+TEST(BfMachineTests, CheckExecutingRightUpToTheMaximumTapeSizeReturnsTrue)
+{
+  auto wrapper = BfMachineWrapper{};
+  auto& machine = wrapper.get();
+  auto const rights = std::string(BfMachineTapeSize_Max - 1, '>');
+  ASSERT_EQ(BfMachine_LoadProgram(&machine, rights.c_str()), BfBool_True);
+
+  ASSERT_EQ(BfMachine_ExecuteProgram(&machine), BfBool_True);
+
+  ASSERT_EQ(machine.data_pointer, BfMachineTapeSize_Max - 1);
+  ASSERT_EQ(machine.buffer_size, BfMachineTapeSize_Max);
+}
+
 TEST(BfMachineTests, GivenTheIoDriversReadValueIsNullCheckThatExecutingDotReturnsTrue)
 {
   auto ioDriver = BfIoDriver{};
@@ -469,6 +502,199 @@ TEST(BfMachineTests, GivenTheIoDriverHasAWriteValueFunctionCheckThatExecutingCom
   ASSERT_EQ(BfMachine_ExecuteProgram(&machine), BfBool_True);
 }
 
+TEST(BfProgramTests, CheckCreateReturnsNullWhenGivenANullSource)
+{
+  ASSERT_EQ(BfProgram_Create(nullptr), nullptr);
+}
+
+TEST(BfProgramTests, CheckReleaseReturnsFalseWhenGivenANullProgram)
+{
+  ASSERT_EQ(BfProgram_Release(nullptr), BfBool_False);
+}
+
+TEST(BfProgramTests, CheckCreateCopiesTheSource)
+{
+  auto source = std::string("+>-");
+  auto* const program = BfProgram_Create(source.c_str());
+  ASSERT_NE(program, nullptr);
+  source[0] = '<';
+
+  EXPECT_STREQ(BfProgram_GetSource(program), "+>-");
+  EXPECT_NE(BfProgram_GetSource(program), source.c_str());
+  ASSERT_EQ(BfProgram_Release(program), BfBool_True);
+}
+
+TEST(BfMachineTests, CheckLoadSharedProgramReturnsFalseWhenGivenANullMachineOrProgram)
+{
+  auto* const program = BfProgram_Create("");
+  ASSERT_NE(program, nullptr);
+  auto wrapper = BfMachineWrapper{};
+  auto& machine = wrapper.get();
+
+  EXPECT_EQ(BfMachine_LoadSharedProgram(nullptr, program), BfBool_False);
+  EXPECT_EQ(BfMachine_LoadSharedProgram(&machine, nullptr), BfBool_False);
+  ASSERT_EQ(BfProgram_Release(program), BfBool_True);
+}
+
+TEST(BfMachineTests, CheckLoadingASharedProgramKeepsItAliveAfterTheCallerReleasesIt)
+{
+  auto* const program = BfProgram_Create("+");
+  ASSERT_NE(program, nullptr);
+  auto wrapper = BfMachineWrapper{};
+  auto& machine = wrapper.get();
+  ASSERT_EQ(BfMachine_LoadSharedProgram(&machine, program), BfBool_True);
+  auto const* const source = BfProgram_GetSource(program);
+  ASSERT_EQ(BfProgram_Release(program), BfBool_True);
+
+  EXPECT_EQ(machine.shared_program, program);
+  EXPECT_EQ(machine.program, source);
+  ASSERT_EQ(BfMachine_ExecuteProgram(&machine), BfBool_True);
+  ASSERT_EQ(machine.buffer[0], 1);
+}
+
+TEST(BfMachineTests, GivenASharedProgramCheckThatMachinesExecuteItWithIndependentState)
+{
+  auto* const program = BfProgram_Create(">+");
+  ASSERT_NE(program, nullptr);
+  auto firstWrapper = BfMachineWrapper{};
+  auto& first = firstWrapper.get();
+  auto secondWrapper = BfMachineWrapper{};
+  auto& second = secondWrapper.get();
+  ASSERT_EQ(BfMachine_LoadSharedProgram(&first, program), BfBool_True);
+  ASSERT_EQ(BfMachine_LoadSharedProgram(&second, program), BfBool_True);
+  ASSERT_EQ(BfProgram_Release(program), BfBool_True);
+
+  ASSERT_EQ(BfMachine_ExecuteProgram(&first), BfBool_True);
+
+  EXPECT_EQ(first.buffer[1], 1);
+  EXPECT_EQ(first.instruction_pointer, 2);
+  EXPECT_EQ(second.buffer[1], 0);
+  EXPECT_EQ(second.instruction_pointer, 0);
+  EXPECT_EQ(first.program, second.program);
+}
+
+TEST(BfMachineTests, CheckCopyingAMachineWithASharedProgramSharesTheProgram)
+{
+  auto* const program = BfProgram_Create("+");
+  ASSERT_NE(program, nullptr);
+  auto wrapper = BfMachineWrapper{};
+  auto& src = wrapper.get();
+  ASSERT_EQ(BfMachine_LoadSharedProgram(&src, program), BfBool_True);
+  ASSERT_EQ(BfProgram_Release(program), BfBool_True);
+
+  auto copyWrapper = BfMachineWrapper{ wrapper };
+  auto& dest = copyWrapper.get();
+  ASSERT_EQ(BfMachine_ClearProgram(&src), BfBool_True);
+
+  EXPECT_EQ(dest.shared_program, program);
+  ASSERT_EQ(BfMachine_ExecuteProgram(&dest), BfBool_True);
+  ASSERT_EQ(dest.buffer[0], 1);
+}
+
+// A machine with a shared program, alongside a keeper machine holding the only other reference.
+// After each test the keeper must still be able to run the program.
+class BfSharedProgramTests : public testing::Test
+{
+protected:
+  void SetUp() override
+  {
+    m_program = BfProgram_Create("+");
+    ASSERT_NE(m_program, nullptr);
+    ASSERT_EQ(BfMachine_LoadSharedProgram(&m_keeper.get(), m_program), BfBool_True);
+    ASSERT_EQ(BfProgram_Release(m_program), BfBool_True);
+    ASSERT_EQ(BfMachine_LoadSharedProgram(&m_machine.get(), m_program), BfBool_True);
+  }
+
+  void TearDown() override
+  {
+    auto& keeper = m_keeper.get();
+    ASSERT_EQ(BfMachine_ExecuteProgram(&keeper), BfBool_True);
+    ASSERT_EQ(keeper.buffer[0], 1);
+  }
+
+  BfProgram* m_program = nullptr;
+  BfMachineWrapper m_keeper;
+  BfMachineWrapper m_machine;
+};
+
+TEST_F(BfSharedProgramTests, CheckThatCleanReleasesTheSharedProgram)
+{
+  auto& machine = m_machine.get();
+
+  ASSERT_EQ(BfMachine_Clean(&machine), BfBool_True);
+
+  ASSERT_EQ(machine.shared_program, nullptr);
+}
+
+TEST_F(BfSharedProgramTests, CheckThatClearProgramReleasesTheSharedProgram)
+{
+  auto& machine = m_machine.get();
+
+  ASSERT_EQ(BfMachine_ClearProgram(&machine), BfBool_True);
+
+  EXPECT_EQ(machine.program, nullptr);
+  ASSERT_EQ(machine.shared_program, nullptr);
+}
+
+TEST_F(BfSharedProgramTests, CheckThatLoadingABorrowedProgramReleasesTheSharedProgram)
+{
+  auto& machine = m_machine.get();
+  auto const borrowed = std::string("-");
+
+  ASSERT_EQ(BfMachine_LoadProgram(&machine, borrowed.c_str()), BfBool_True);
+
+  EXPECT_EQ(machine.program, borrowed.c_str());
+  ASSERT_EQ(machine.shared_program, nullptr);
+}
+
+TEST_F(BfSharedProgramTests, CheckThatLoadingAnotherSharedProgramReplacesTheSharedProgram)
+{
+  auto& machine = m_machine.get();
+  auto* const other = BfProgram_Create("-");
+  ASSERT_NE(other, nullptr);
+  auto const* const otherSource = BfProgram_GetSource(other);
+
+  ASSERT_EQ(BfMachine_LoadSharedProgram(&machine, other), BfBool_True);
+  ASSERT_EQ(BfProgram_Release(other), BfBool_True);
+
+  EXPECT_EQ(machine.shared_program, other);
+  EXPECT_EQ(machine.program, otherSource);
+  ASSERT_EQ(BfMachine_ExecuteProgram(&machine), BfBool_True);
+  ASSERT_EQ(machine.buffer[0], -1);
+}
+
+TEST(BfMachineTests, GivenASharedProgramCheckThatMachinesOnSeveralThreadsCanLoadRunAndReleaseIt)
+{
+  auto constexpr threadCount = 8;
+  auto constexpr iterationCount = 1000;
+  auto* const program = BfProgram_Create(">+>++");
+  ASSERT_NE(program, nullptr);
+
+  auto results = std::vector<int>(threadCount, 0);
+  auto threads = std::vector<std::thread>{};
+  for (auto i = 0; i < threadCount; ++i)
+    threads.emplace_back([program, &result = results[i]]()
+    {
+      for (auto j = 0; j < iterationCount; ++j)
+      {
+        auto wrapper = BfMachineWrapper{};
+        auto& machine = wrapper.get();
+        if (BfMachine_LoadSharedProgram(&machine, program) != BfBool_True
+          || BfMachine_ExecuteProgram(&machine) != BfBool_True
+          || machine.buffer[1] != 1
+          || machine.buffer[2] != 2
+          || BfMachine_ClearProgram(&machine) != BfBool_True)
+          return;
+        ++result;
+      }
+    });
+  for (auto& thread : threads)
+    thread.join();
+
+  EXPECT_THAT(results, testing::Each(iterationCount));
+  ASSERT_EQ(BfProgram_Release(program), BfBool_True);
+}
+
 int main(int argc, char* argv[])
 {
   testing::InitGoogleTest(&argc, argv);